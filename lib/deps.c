@@ -0,0 +1,966 @@
+#include "deps.h"
+
+#include <elf.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glob.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The most symlinks followed while resolving a path, as in the kernel.
+#define DEP_MAX_SYMLINKS 40
+
+// The deepest chain of ld.so.conf include directives followed.
+#define DEP_MAX_CONF_DEPTH 8
+
+// Directories searched after those from ld.so.conf, relative to the sysroot.
+// The multiarch directories of the root object's machine are searched first.
+static const char *default_lib_dirs[] = {
+    "/lib64",
+    "/usr/lib64",
+    "/lib",
+    "/usr/lib",
+};
+
+// Returns the Debian multiarch triplet of 'machine', or NULL if unknown.
+static const char *multiarch_triplet(uint16_t machine) {
+    switch (machine) {
+        case EM_X86_64:
+            return "x86_64-linux-gnu";
+        case EM_AARCH64:
+            return "aarch64-linux-gnu";
+        case EM_RISCV:
+            return "riscv64-linux-gnu";
+        case EM_PPC64:
+            return "powerpc64le-linux-gnu";
+        case EM_S390:
+            return "s390x-linux-gnu";
+        default:
+            return NULL;
+    }
+}
+
+// Reads 'size' bytes at 'offset' into a null terminated buffer.
+static char *read_range(FILE *fp, uint64_t offset, uint64_t size) {
+    char *data = calloc(size + 1, 1);
+    if (!data) return NULL;
+    if (fseek(fp, offset, SEEK_SET) < 0 ||
+        (size && fread(data, size, 1, fp) != 1)) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// Reads the ELF header and returns 0 if it is a 64-bit ELF file for the
+// given machine.
+static int read_compatible_header(FILE *fp, uint16_t machine,
+                                  Elf64_Ehdr *ehdr) {
+    if (fread(ehdr, sizeof(Elf64_Ehdr), 1, fp) != 1) return -1;
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) return -1;
+    if (ehdr->e_ident[EI_CLASS] != ELFCLASS64) return -1;
+    if (ehdr->e_machine != machine) return -1;
+    return 0;
+}
+
+// Same as read_program_headers and read_section_headers, without logging, as
+// these are called for every object in the graph from several threads.
+static int read_headers(FILE *fp, uint16_t machine, elf_ctx *ctx) {
+    if (read_compatible_header(fp, machine, &ctx->elf_header) != 0) return -1;
+
+    ctx->n_prog_hdrs = ctx->elf_header.e_phnum;
+    ctx->program_headers = (Elf64_Phdr *)read_range(
+        fp, ctx->elf_header.e_phoff, ctx->n_prog_hdrs * sizeof(Elf64_Phdr));
+    if (!ctx->program_headers) return -1;
+
+    ctx->n_sections = ctx->elf_header.e_shnum;
+    ctx->section_headers = (Elf64_Shdr *)read_range(
+        fp, ctx->elf_header.e_shoff, ctx->n_sections * sizeof(Elf64_Shdr));
+    if (!ctx->section_headers) return -1;
+
+    return 0;
+}
+
+// Returns in 'n' the number of dynamic symbols, from DT_HASH or DT_GNU_HASH
+// as ld.so does, since objects need not have section headers. Returns 0 on
+// success or -1 if neither table can be read.
+static int count_dynsyms(FILE *fp, elf_ctx *ctx, uint64_t hash,
+                         uint64_t gnu_hash, uint64_t *n) {
+    uint64_t off;
+
+    // the second word of DT_HASH is the number of chain entries, which is
+    // the number of symbols.
+    if (hash && vaddr_to_offset(ctx, hash, &off) == 0) {
+        uint32_t *hdr = (uint32_t *)read_range(fp, off, 2 * sizeof(uint32_t));
+        if (!hdr) return -1;
+        *n = hdr[1];
+        free(hdr);
+        return 0;
+    }
+
+    if (!gnu_hash || vaddr_to_offset(ctx, gnu_hash, &off) != 0) return -1;
+    uint32_t *hdr = (uint32_t *)read_range(fp, off, 4 * sizeof(uint32_t));
+    if (!hdr) return -1;
+    uint32_t n_buckets = hdr[0], sym_offset = hdr[1], bloom_size = hdr[2];
+    free(hdr);
+
+    // DT_GNU_HASH has no symbol count. the last symbol is the end of the
+    // chain starting at the highest bucket.
+    uint64_t buckets_off = off + 4 * sizeof(uint32_t) +
+                           (uint64_t)bloom_size * sizeof(uint64_t);
+    uint32_t *buckets = (uint32_t *)read_range(
+        fp, buckets_off, (uint64_t)n_buckets * sizeof(uint32_t));
+    if (!buckets) return -1;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < n_buckets; i++)
+        if (buckets[i] > last) last = buckets[i];
+    free(buckets);
+
+    if (last < sym_offset) {
+        *n = sym_offset;
+        return 0;
+    }
+
+    uint64_t chain_off = buckets_off + (uint64_t)n_buckets * sizeof(uint32_t);
+    uint32_t val;
+    if (fseek(fp, chain_off + (uint64_t)(last - sym_offset) * sizeof(val),
+              SEEK_SET) < 0)
+        return -1;
+    do {
+        if (fread(&val, sizeof(val), 1, fp) != 1) return -1;
+        last++;
+    } while (!(val & 1));
+    *n = last;
+    return 0;
+}
+
+// Reads the dynamic symbol table of 'node' using the section headers in
+// 'ctx'. Returns 0 on success, 1 if there is no SHT_DYNSYM section or -1 on
+// failure.
+static int load_dynsym_section(FILE *fp, elf_ctx *ctx, dep_node *node) {
+    Elf64_Shdr *dynsym = NULL;
+    for (uint64_t i = 0; i < ctx->n_sections; i++) {
+        if (ctx->section_headers[i].sh_type == SHT_DYNSYM) {
+            dynsym = &ctx->section_headers[i];
+            break;
+        }
+    }
+    if (!dynsym || dynsym->sh_link >= ctx->n_sections) return 1;
+
+    Elf64_Shdr *dynstr = &ctx->section_headers[dynsym->sh_link];
+    node->dynsyms = (Elf64_Sym *)read_range(fp, dynsym->sh_offset,
+                                            dynsym->sh_size);
+    node->dynstr = read_range(fp, dynstr->sh_offset, dynstr->sh_size);
+    if (!node->dynsyms || !node->dynstr) return -1;
+    node->n_dynsyms = dynsym->sh_size / sizeof(Elf64_Sym);
+    node->dynstr_size = dynstr->sh_size;
+    return 0;
+}
+
+// Fills in the DT_NEEDED, DT_RPATH, DT_RUNPATH and dynamic symbol table
+// information of 'node' from the PT_DYNAMIC segment of the parsed headers in
+// 'ctx'.
+static int load_dynamic_info(FILE *fp, elf_ctx *ctx, dep_node *node) {
+    uint64_t n_dyn = 0;
+    uint64_t strtab = 0, strsz = 0, strtab_off;
+    uint64_t symtab = 0, syment = sizeof(Elf64_Sym), hash = 0, gnu_hash = 0;
+    Elf64_Dyn *dyn = read_dynamic(fp, ctx, &n_dyn);
+
+    // a statically linked object has no dependencies.
+    if (!dyn) return 0;
+
+    for (uint64_t i = 0; i < n_dyn; i++) {
+        switch (dyn[i].d_tag) {
+            case DT_STRTAB:
+                strtab = dyn[i].d_un.d_ptr;
+                break;
+            case DT_STRSZ:
+                strsz = dyn[i].d_un.d_val;
+                break;
+            case DT_SYMTAB:
+                symtab = dyn[i].d_un.d_ptr;
+                break;
+            case DT_SYMENT:
+                syment = dyn[i].d_un.d_val;
+                break;
+            case DT_HASH:
+                hash = dyn[i].d_un.d_ptr;
+                break;
+            case DT_GNU_HASH:
+                gnu_hash = dyn[i].d_un.d_ptr;
+                break;
+            case DT_NEEDED:
+                node->n_needed++;
+                break;
+        }
+    }
+
+    char *strs = NULL;
+    if (vaddr_to_offset(ctx, strtab, &strtab_off) == 0)
+        strs = read_range(fp, strtab_off, strsz);
+    if (!strs) {
+        free(dyn);
+        node->n_needed = 0;
+        return -1;
+    }
+
+    node->needed = calloc(node->n_needed, sizeof(char *));
+    node->needed_idx = calloc(node->n_needed, sizeof(uint64_t));
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < n_dyn; i++) {
+        if (dyn[i].d_un.d_val >= strsz) continue;
+        char *str = strs + dyn[i].d_un.d_val;
+        switch (dyn[i].d_tag) {
+            case DT_NEEDED:
+                node->needed[n++] = strdup(str);
+                break;
+            case DT_RPATH:
+                node->rpath = strdup(str);
+                break;
+            case DT_RUNPATH:
+                node->runpath = strdup(str);
+                break;
+        }
+    }
+    node->n_needed = n;
+    free(dyn);
+
+    // section headers give the exact size of the symbol table. without them
+    // it is sized from the hash tables, as ld.so does. DT_GNU_HASH does not
+    // cover undefined symbols after its last hashed one, so it is only the
+    // fallback.
+    int r = load_dynsym_section(fp, ctx, node);
+    if (r <= 0) {
+        free(strs);
+        return r;
+    }
+
+    // DT_STRTAB is also the string table of DT_SYMTAB.
+    uint64_t symtab_off, n_syms;
+    if (!symtab || syment != sizeof(Elf64_Sym) ||
+        vaddr_to_offset(ctx, symtab, &symtab_off) != 0 ||
+        count_dynsyms(fp, ctx, hash, gnu_hash, &n_syms) != 0) {
+        free(strs);
+        node->no_symbols = 1;
+        return 0;
+    }
+
+    node->dynsyms = (Elf64_Sym *)read_range(fp, symtab_off,
+                                            n_syms * sizeof(Elf64_Sym));
+    if (!node->dynsyms) {
+        free(strs);
+        return -1;
+    }
+    node->n_dynsyms = n_syms;
+    node->dynstr = strs;
+    node->dynstr_size = strsz;
+    return 0;
+}
+
+// Returns a newly allocated copy of the directory part of 'path'.
+static char *path_dirname(const char *path) {
+    if (!path) return strdup(".");
+    char *dir = strdup(path);
+    char *slash = strrchr(dir, '/');
+    if (!slash) {
+        free(dir);
+        return strdup(".");
+    }
+    if (slash == dir) slash++;
+    *slash = '\0';
+    return dir;
+}
+
+// Resolves 'path' as if 'root' were the root directory, writing the host
+// path to 'out'. Symlinks are followed by hand so neither absolute targets
+// nor ".." can leave the root, and the result contains no symlinks. Returns 0
+// on success or -1 if the path does not exist.
+static int resolve_in_root(const char *root, const char *path, char *out,
+                           size_t size) {
+    char rest[4096], tmp[4096], target[4096];
+    char res[4096] = "";
+    char host[8192];
+    int links = 0;
+
+    if (snprintf(rest, sizeof(rest), "%s", path) >= (int)sizeof(rest))
+        return -1;
+
+    for (char *p = rest;;) {
+        while (*p == '/') p++;
+        if (!*p) break;
+
+        char *comp = p;
+        size_t len = strcspn(p, "/");
+        p += len;
+        if (*p) *p++ = '\0';
+
+        if (strcmp(comp, ".") == 0) continue;
+        if (strcmp(comp, "..") == 0) {
+            char *slash = strrchr(res, '/');
+            if (slash) *slash = '\0';
+            continue;
+        }
+
+        size_t res_len = strlen(res);
+        if (res_len + 1 + len >= sizeof(res)) return -1;
+        snprintf(host, sizeof(host), "%s%s/%s", root, res, comp);
+
+        struct stat st;
+        if (lstat(host, &st) != 0) return -1;
+        if (!S_ISLNK(st.st_mode)) {
+            res[res_len] = '/';
+            memcpy(res + res_len + 1, comp, len + 1);
+            continue;
+        }
+
+        if (++links > DEP_MAX_SYMLINKS) return -1;
+        ssize_t n = readlink(host, target, sizeof(target) - 1);
+        if (n < 0) return -1;
+        target[n] = '\0';
+        // an absolute target restarts from the root, a relative one from the
+        // directory containing the link.
+        if (target[0] == '/') res[0] = '\0';
+        if (snprintf(tmp, sizeof(tmp), "%s/%s", target, p) >= (int)sizeof(tmp))
+            return -1;
+        memcpy(rest, tmp, strlen(tmp) + 1);
+        p = rest;
+    }
+
+    if (snprintf(out, size, "%s%s", root, res[0] ? res : "/") >= (int)size)
+        return -1;
+    return 0;
+}
+
+// Returns 1 if the host path 'path' is inside the sysroot.
+static int in_sysroot(dep_graph *graph, const char *path) {
+    size_t len = strlen(graph->sysroot);
+    return strncmp(path, graph->sysroot, len) == 0 && path[len] == '/';
+}
+
+// Checks whether 'path' is a compatible ELF file and if so stores it in
+// 'node'. 'path' itself is kept in 'origin_path' for $ORIGIN, and its
+// symlink free host path in 'path'. Paths inside the sysroot are resolved
+// with resolve_in_root so that links in the image can not point at host
+// files. Returns 0 if the file was found, -1 otherwise.
+static int try_path(dep_graph *graph, const char *path, dep_node *node) {
+    char real[4096];
+    Elf64_Ehdr ehdr;
+
+    if (graph->sysroot[0] && in_sysroot(graph, path)) {
+        if (resolve_in_root(graph->sysroot, path + strlen(graph->sysroot),
+                            real, sizeof(real)) != 0)
+            return -1;
+    } else if (snprintf(real, sizeof(real), "%s", path) >=
+               (int)sizeof(real)) {
+        return -1;
+    }
+
+    FILE *fp = fopen(real, "r");
+    if (!fp) return -1;
+    int ok = read_compatible_header(fp, graph->machine, &ehdr) == 0;
+    fclose(fp);
+    if (!ok) return -1;
+
+    node->path = strdup(real);
+    node->origin_path = strdup(path);
+    return 0;
+}
+
+// Returns the length of the dynamic string token 'token' at 'str', which
+// starts after the '$', or 0 if it is not there. As in ld.so, an unbraced
+// token must be followed by a '/' or the end of the string.
+static size_t match_token(const char *str, const char *token) {
+    size_t len = strlen(token);
+    if (str[0] == '{')
+        return strncmp(str + 1, token, len) == 0 && str[len + 1] == '}'
+                   ? len + 2
+                   : 0;
+    if (strncmp(str, token, len) != 0) return 0;
+    return str[len] == '/' || str[len] == '\0' ? len : 0;
+}
+
+// Expands the $ORIGIN tokens in 'dir' to the directory of 'origin' and writes
+// the result to 'out'. Returns 1 if a $ORIGIN token was expanded, 0 if there
+// was none, or -1 if the directory should be skipped. $LIB and $PLATFORM
+// depend on the machine the loader runs on and are not supported, so
+// directories using them are skipped.
+static int expand_dir(const char *dir, const char *origin, char *out,
+                      size_t size) {
+    size_t n = 0;
+    int expanded = 0;
+
+    for (const char *p = dir; *p;) {
+        size_t len = 0;
+        const char *sub = NULL;
+        char *origin_dir = NULL;
+
+        if (*p == '$') {
+            if ((len = match_token(p + 1, "ORIGIN"))) {
+                sub = origin_dir = path_dirname(origin);
+                expanded = 1;
+            } else if (match_token(p + 1, "LIB") ||
+                       match_token(p + 1, "PLATFORM")) {
+                return -1;
+            }
+        }
+        if (!sub) {
+            if (n + 1 >= size) return -1;
+            out[n++] = *p++;
+            continue;
+        }
+        size_t sub_len = strlen(sub);
+        if (n + sub_len >= size) {
+            free(origin_dir);
+            return -1;
+        }
+        memcpy(out + n, sub, sub_len);
+        n += sub_len;
+        p += len + 1;
+        free(origin_dir);
+    }
+    out[n] = '\0';
+    return expanded;
+}
+
+// Searches the ':' separated list of directories in 'dirs' for 'node'.
+// Directories using $ORIGIN are expanded relative to the directory of
+// 'origin' and are not prefixed with the sysroot, as they are already host
+// paths. Returns 0 if the node was found, -1 otherwise.
+static int search_dirs(dep_graph *graph, const char *dirs, const char *origin,
+                       dep_node *node) {
+    char dir[4096];
+    char path[4096];
+    char *list = strdup(dirs);
+    char *save = NULL;
+    int found = -1;
+
+    for (char *entry = strtok_r(list, ":", &save); entry && found != 0;
+         entry = strtok_r(NULL, ":", &save)) {
+        int expanded = expand_dir(entry, origin, dir, sizeof(dir));
+        if (expanded < 0) continue;
+
+        if (snprintf(path, sizeof(path), "%s%s/%s",
+                     expanded ? "" : graph->sysroot, dir,
+                     node->name) < (int)sizeof(path))
+            found = try_path(graph, path, node);
+    }
+
+    free(list);
+    return found;
+}
+
+// Appends 'dir' to the graph's library directories unless already present.
+static void add_lib_dir(dep_graph *graph, const char *dir) {
+    for (uint64_t i = 0; i < graph->n_lib_dirs; i++)
+        if (strcmp(graph->lib_dirs[i], dir) == 0) return;
+    char **tmp =
+        realloc(graph->lib_dirs, (graph->n_lib_dirs + 1) * sizeof(char *));
+    if (!tmp) {
+        perror("realloc");
+        return;
+    }
+    graph->lib_dirs = tmp;
+    graph->lib_dirs[graph->n_lib_dirs++] = strdup(dir);
+}
+
+// Maps the path 'path' in the sysroot to a host path.
+static int host_path(dep_graph *graph, const char *path, char *out,
+                     size_t size) {
+    if (graph->sysroot[0])
+        return resolve_in_root(graph->sysroot, path, out, size);
+    return snprintf(out, size, "%s", path) < (int)size ? 0 : -1;
+}
+
+static void read_ld_so_conf(dep_graph *graph, const char *conf, int depth);
+
+// Reads every ld.so.conf file matching the glob 'pattern', in sorted order.
+// A relative pattern is relative to the directory of 'conf'.
+static void include_ld_so_conf(dep_graph *graph, const char *conf,
+                               const char *pattern, int depth) {
+    char full[4096], host_dir[4096], host_pattern[8192], file[8192];
+    glob_t g;
+
+    if (pattern[0] == '/') {
+        snprintf(full, sizeof(full), "%s", pattern);
+    } else {
+        char *dir = path_dirname(conf);
+        snprintf(full, sizeof(full), "%s/%s", dir, pattern);
+        free(dir);
+    }
+
+    // resolve the directory within the sysroot and glob only the file name.
+    char *slash = strrchr(full, '/');
+    *slash = '\0';
+    const char *dir = full[0] ? full : "/";
+    if (host_path(graph, dir, host_dir, sizeof(host_dir)) != 0) return;
+    snprintf(host_pattern, sizeof(host_pattern), "%s/%s", host_dir,
+             slash + 1);
+
+    if (glob(host_pattern, 0, NULL, &g) != 0) return;
+    for (size_t i = 0; i < g.gl_pathc; i++) {
+        snprintf(file, sizeof(file), "%s/%s", full,
+                 strrchr(g.gl_pathv[i], '/') + 1);
+        read_ld_so_conf(graph, file, depth + 1);
+    }
+    globfree(&g);
+}
+
+// Adds the directories listed in the ld.so.conf file 'conf', a path in the
+// sysroot, to the graph's library directories, following include
+// directives. ld.so.cache is built from these same directories, so they are
+// searched directly rather than reading the cache.
+static void read_ld_so_conf(dep_graph *graph, const char *conf, int depth) {
+    char host[4096];
+    char *line = NULL;
+    size_t cap = 0;
+
+    if (depth > DEP_MAX_CONF_DEPTH) return;
+    if (host_path(graph, conf, host, sizeof(host)) != 0) return;
+    FILE *fp = fopen(host, "r");
+    if (!fp) return;
+
+    while (getline(&line, &cap, fp) >= 0) {
+        char *p = line;
+        char *end = strchr(p, '#');
+        if (!end) end = p + strlen(p);
+        while (end > p && strchr(" \t\r\n", end[-1])) end--;
+        *end = '\0';
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) continue;
+
+        if (strncmp(p, "include", 7) == 0 && (p[7] == ' ' || p[7] == '\t')) {
+            char *save = NULL;
+            for (char *pat = strtok_r(p + 8, " \t", &save); pat;
+                 pat = strtok_r(NULL, " \t", &save))
+                include_ld_so_conf(graph, conf, pat, depth);
+            continue;
+        }
+        if (strncmp(p, "hwcap", 5) == 0 && (p[5] == ' ' || p[5] == '\t'))
+            continue;
+
+        // old style "dir=TYPE" entries.
+        char *eq = strchr(p, '=');
+        if (eq) *eq = '\0';
+        size_t len = strlen(p);
+        while (len > 1 && p[len - 1] == '/') p[--len] = '\0';
+        if (p[0] == '/') add_lib_dir(graph, p);
+    }
+
+    free(line);
+    fclose(fp);
+}
+
+// Fills in the graph's library directories: those listed in the sysroot's
+// ld.so.conf, then the multiarch and default directories.
+static void load_lib_dirs(dep_graph *graph) {
+    char dir[64];
+    const char *triplet = multiarch_triplet(graph->machine);
+
+    read_ld_so_conf(graph, "/etc/ld.so.conf", 0);
+    if (triplet) {
+        snprintf(dir, sizeof(dir), "/lib/%s", triplet);
+        add_lib_dir(graph, dir);
+        snprintf(dir, sizeof(dir), "/usr/lib/%s", triplet);
+        add_lib_dir(graph, dir);
+    }
+    for (size_t i = 0;
+         i < sizeof(default_lib_dirs) / sizeof(default_lib_dirs[0]); i++)
+        add_lib_dir(graph, default_lib_dirs[i]);
+}
+
+// Resolves the path of 'node' the way the dynamic loader would, using the
+// search paths of the node which requested it.
+static int resolve_dep(dep_graph *graph, dep_node *node) {
+    char path[4096];
+    dep_node *parent = &graph->nodes[node->parent];
+    int found = -1;
+
+    if (strchr(node->name, '/')) {
+        snprintf(path, sizeof(path), "%s%s",
+                 node->name[0] == '/' ? graph->sysroot : "", node->name);
+        return try_path(graph, path, node);
+    }
+
+    // DT_RPATH of the requesting object and the objects which loaded it is
+    // only used when the requesting object has no DT_RUNPATH. $ORIGIN is the
+    // directory an object was found in, before following symlinks.
+    if (!parent->runpath) {
+        uint64_t i = node->parent;
+        for (;;) {
+            dep_node *n = &graph->nodes[i];
+            if (n->rpath)
+                found = search_dirs(graph, n->rpath, n->origin_path, node);
+            if (found == 0 || n->parent == i) break;
+            i = n->parent;
+        }
+    } else {
+        found =
+            search_dirs(graph, parent->runpath, parent->origin_path, node);
+    }
+
+    for (uint64_t i = 0; found != 0 && i < graph->n_lib_dirs; i++) {
+        snprintf(path, sizeof(path), "%s%s/%s", graph->sysroot,
+                 graph->lib_dirs[i], node->name);
+        found = try_path(graph, path, node);
+    }
+    return found;
+}
+
+static uint64_t hash_name(const char *name) {
+    uint64_t h = 0xcbf29ce484222325;
+    for (; *name; name++) {
+        h ^= (unsigned char)*name;
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+static uint64_t hash_file(uint64_t dev, uint64_t ino) {
+    uint64_t h = dev * 0x9e3779b97f4a7c15 ^ ino;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    return h;
+}
+
+// Returns the slot for 'name' in the name table, which is either empty or
+// holds the index + 1 of the node requested by that name.
+static uint64_t *name_slot(dep_graph *graph, const char *name) {
+    uint64_t mask = graph->slots_cap - 1;
+    for (uint64_t h = hash_name(name) & mask;; h = (h + 1) & mask) {
+        uint64_t slot = graph->name_slots[h];
+        if (!slot || strcmp(graph->nodes[slot - 1].name, name) == 0)
+            return &graph->name_slots[h];
+    }
+}
+
+// Returns the slot for a file in the file table, which is either empty or
+// holds the index + 1 of the node resolved to that file.
+static uint64_t *file_slot(dep_graph *graph, uint64_t dev, uint64_t ino) {
+    uint64_t mask = graph->slots_cap - 1;
+    for (uint64_t h = hash_file(dev, ino) & mask;; h = (h + 1) & mask) {
+        uint64_t slot = graph->file_slots[h];
+        if (!slot || (graph->nodes[slot - 1].dev == dev &&
+                      graph->nodes[slot - 1].ino == ino))
+            return &graph->file_slots[h];
+    }
+}
+
+// Grows the name and file tables so they stay at most half full, rebuilding
+// them from the nodes.
+static int grow_slots(dep_graph *graph) {
+    if (graph->n_nodes * 2 < graph->slots_cap) return 0;
+
+    uint64_t cap = graph->slots_cap ? graph->slots_cap * 2 : 64;
+    uint64_t *names = calloc(cap, sizeof(uint64_t));
+    uint64_t *files = calloc(cap, sizeof(uint64_t));
+    if (!names || !files) {
+        perror("calloc");
+        free(names);
+        free(files);
+        return -1;
+    }
+    free(graph->name_slots);
+    free(graph->file_slots);
+    graph->name_slots = names;
+    graph->file_slots = files;
+    graph->slots_cap = cap;
+
+    // the root is requested by its path rather than a DT_NEEDED name.
+    for (uint64_t i = 0; i < graph->n_nodes; i++) {
+        dep_node *node = &graph->nodes[i];
+        if (i > 0) *name_slot(graph, node->name) = i + 1;
+        if (node->ino && node->alias < 0)
+            *file_slot(graph, node->dev, node->ino) = i + 1;
+    }
+    return 0;
+}
+
+// Finds the file of 'node', run before deduplicating by file.
+static void locate_dep(dep_graph *graph, dep_node *node) {
+    struct stat st;
+
+    if (resolve_dep(graph, node) != 0) return;
+    node->outside_sysroot =
+        graph->sysroot[0] && !in_sysroot(graph, node->path);
+
+    if (stat(node->path, &st) != 0) {
+        node->error = 1;
+        return;
+    }
+    node->dev = st.st_dev;
+    node->ino = st.st_ino;
+}
+
+static void parse_dep(dep_graph *graph, dep_node *node) {
+    elf_ctx ctx = {0};
+
+    if (!node->path || node->error || node->alias >= 0) return;
+
+    FILE *fp = fopen(node->path, "r");
+    if (!fp) {
+        node->error = 1;
+        return;
+    }
+    if (read_headers(fp, graph->machine, &ctx) != 0 ||
+        load_dynamic_info(fp, &ctx, node) != 0)
+        node->error = 1;
+
+    free(ctx.program_headers);
+    free(ctx.section_headers);
+    fclose(fp);
+}
+
+typedef struct dep_worker {
+    dep_graph *graph;
+    void (*fn)(dep_graph *graph, dep_node *node);
+    // The next node index to process, shared by all threads.
+    uint64_t next;
+    uint64_t end;
+} dep_worker;
+
+static void *dep_worker_run(void *arg) {
+    dep_worker *w = arg;
+    for (;;) {
+        uint64_t i = __atomic_fetch_add(&w->next, 1, __ATOMIC_RELAXED);
+        if (i >= w->end) break;
+        w->fn(w->graph, &w->graph->nodes[i]);
+    }
+    return NULL;
+}
+
+// Calls 'fn' on nodes [begin, end) using up to 'n_threads' threads, including
+// the calling thread.
+static void run_deps(dep_graph *graph, uint64_t begin, uint64_t end,
+                     int n_threads,
+                     void (*fn)(dep_graph *graph, dep_node *node)) {
+    dep_worker w = {.graph = graph, .fn = fn, .next = begin, .end = end};
+    pthread_t threads[64];
+    int n = 0;
+
+    if ((uint64_t)n_threads > end - begin) n_threads = end - begin;
+    if (n_threads > 64) n_threads = 64;
+
+    for (; n < n_threads - 1; n++) {
+        if (pthread_create(&threads[n], NULL, dep_worker_run, &w) != 0) break;
+    }
+    dep_worker_run(&w);
+    for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+}
+
+static int64_t add_node(dep_graph *graph, char *name, uint64_t parent) {
+    if (graph->n_nodes == graph->cap) {
+        uint64_t new_cap = graph->cap ? graph->cap * 2 : 16;
+        dep_node *tmp = realloc(graph->nodes, new_cap * sizeof(dep_node));
+        if (!tmp) {
+            perror("realloc");
+            return -1;
+        }
+        graph->nodes = tmp;
+        graph->cap = new_cap;
+    }
+    dep_node *node = &graph->nodes[graph->n_nodes];
+    memset(node, 0, sizeof(dep_node));
+    node->name = strdup(name);
+    node->parent = parent;
+    node->alias = -1;
+    graph->n_nodes++;
+    if (grow_slots(graph) != 0) return -1;
+    return graph->n_nodes - 1;
+}
+
+int build_dep_graph(elf_ctx *ctx, const char *sysroot, int n_threads,
+                    dep_graph *graph) {
+    memset(graph, 0, sizeof(dep_graph));
+    graph->machine = ctx->elf_header.e_machine;
+
+    // compare against the sysroot with its own symlinks resolved, as the
+    // paths in the graph will be. A sysroot of "/" is the host root.
+    graph->sysroot = sysroot && sysroot[0] ? realpath(sysroot, NULL) : NULL;
+    if (sysroot && sysroot[0] && !graph->sysroot) {
+        perror("realpath");
+        return -1;
+    }
+    if (!graph->sysroot || strcmp(graph->sysroot, "/") == 0) {
+        free(graph->sysroot);
+        graph->sysroot = strdup("");
+    }
+
+    load_lib_dirs(graph);
+
+    if (add_node(graph, ctx->path ? (char *)ctx->path : "<root>", 0) < 0)
+        return -1;
+    if (ctx->path) {
+        dep_node *root = &graph->nodes[0];
+        root->path = realpath(ctx->path, NULL);
+        if (!root->path) root->path = strdup(ctx->path);
+        root->origin_path = strdup(root->path);
+        root->outside_sysroot =
+            graph->sysroot[0] && !in_sysroot(graph, root->path);
+    }
+    if (load_dynamic_info(ctx->fp, ctx, &graph->nodes[0]) != 0) {
+        graph->nodes[0].error = 1;
+        rewind(ctx->fp);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fileno(ctx->fp), &st) == 0) {
+        graph->nodes[0].dev = st.st_dev;
+        graph->nodes[0].ino = st.st_ino;
+        *file_slot(graph, st.st_dev, st.st_ino) = 1;
+    }
+
+    // expand the graph a level at a time. objects are deduplicated by the
+    // name they are requested by, as the dynamic loader does, and then by
+    // the file they resolve to, so every file is parsed once.
+    uint64_t begin = 0, end = 1;
+    while (begin < end) {
+        for (uint64_t i = begin; i < end; i++) {
+            for (uint64_t j = 0; j < graph->nodes[i].n_needed; j++) {
+                char *name = graph->nodes[i].needed[j];
+                uint64_t *slot = name_slot(graph, name);
+                int64_t idx = *slot ? (int64_t)*slot - 1 : -1;
+                if (idx < 0) {
+                    idx = add_node(graph, name, i);
+                    if (idx < 0) {
+                        rewind(ctx->fp);
+                        return -1;
+                    }
+                    *name_slot(graph, name) = idx + 1;
+                } else if (graph->nodes[idx].alias >= 0) {
+                    idx = graph->nodes[idx].alias;
+                }
+                graph->nodes[i].needed_idx[j] = idx;
+            }
+        }
+
+        run_deps(graph, end, graph->n_nodes, n_threads, locate_dep);
+        for (uint64_t i = end; i < graph->n_nodes; i++) {
+            dep_node *node = &graph->nodes[i];
+            if (!node->ino) continue;
+            uint64_t *slot = file_slot(graph, node->dev, node->ino);
+            if (*slot)
+                node->alias = *slot - 1;
+            else
+                *slot = i + 1;
+        }
+        run_deps(graph, end, graph->n_nodes, n_threads, parse_dep);
+
+        // point the edges of this level at the node each file was first
+        // found by.
+        for (uint64_t i = begin; i < end; i++) {
+            dep_node *node = &graph->nodes[i];
+            for (uint64_t j = 0; j < node->n_needed; j++) {
+                dep_node *dep = &graph->nodes[node->needed_idx[j]];
+                if (dep->alias >= 0) node->needed_idx[j] = dep->alias;
+            }
+        }
+
+        begin = end;
+        end = graph->n_nodes;
+    }
+
+    rewind(ctx->fp);
+    return 0;
+}
+
+typedef struct sym_entry {
+    const char *name;
+    uint64_t node;
+} sym_entry;
+
+// Returns the name of 'sym' or NULL if it has none or it is out of bounds.
+static const char *dep_sym_name(dep_node *node, Elf64_Sym *sym) {
+    if (sym->st_name == 0 || sym->st_name >= node->dynstr_size) return NULL;
+    return node->dynstr + sym->st_name;
+}
+
+static int is_global(Elf64_Sym *sym) {
+    int bind = ELF64_ST_BIND(sym->st_info);
+    return bind == STB_GLOBAL || bind == STB_WEAK || bind == STB_GNU_UNIQUE;
+}
+
+int64_t resolve_dep_symbols(dep_graph *graph) {
+    uint64_t n_defined = 0;
+    for (uint64_t i = 0; i < graph->n_nodes; i++)
+        n_defined += graph->nodes[i].n_dynsyms;
+
+    uint64_t cap = 16;
+    while (cap < n_defined * 2) cap <<= 1;
+    sym_entry *table = calloc(cap, sizeof(sym_entry));
+    if (!table) {
+        perror("calloc");
+        return -1;
+    }
+
+    // the first object in load order to define a symbol provides it.
+    for (uint64_t i = 0; i < graph->n_nodes; i++) {
+        dep_node *node = &graph->nodes[i];
+        for (uint64_t j = 0; j < node->n_dynsyms; j++) {
+            Elf64_Sym *sym = &node->dynsyms[j];
+            const char *name = dep_sym_name(node, sym);
+            if (!name || sym->st_shndx == SHN_UNDEF || !is_global(sym))
+                continue;
+            uint64_t h = hash_name(name) & (cap - 1);
+            while (table[h].name && strcmp(table[h].name, name) != 0)
+                h = (h + 1) & (cap - 1);
+            if (!table[h].name) {
+                table[h].name = name;
+                table[h].node = i;
+            }
+        }
+    }
+
+    int64_t unresolved = 0;
+    for (uint64_t i = 0; i < graph->n_nodes; i++) {
+        dep_node *node = &graph->nodes[i];
+        node->providers = calloc(node->n_dynsyms, sizeof(int64_t));
+        for (uint64_t j = 0; j < node->n_dynsyms; j++) {
+            Elf64_Sym *sym = &node->dynsyms[j];
+            const char *name = dep_sym_name(node, sym);
+            node->providers[j] = DEP_SYM_DEFINED;
+            if (!name || sym->st_shndx != SHN_UNDEF || !is_global(sym))
+                continue;
+            uint64_t h = hash_name(name) & (cap - 1);
+            while (table[h].name && strcmp(table[h].name, name) != 0)
+                h = (h + 1) & (cap - 1);
+            if (table[h].name) {
+                node->providers[j] = table[h].node;
+            } else {
+                node->providers[j] = DEP_SYM_UNRESOLVED;
+                if (ELF64_ST_BIND(sym->st_info) != STB_WEAK) unresolved++;
+            }
+        }
+    }
+
+    free(table);
+    return unresolved;
+}
+
+void free_dep_graph(dep_graph *graph) {
+    for (uint64_t i = 0; i < graph->n_nodes; i++) {
+        dep_node *node = &graph->nodes[i];
+        for (uint64_t j = 0; j < node->n_needed; j++) free(node->needed[j]);
+        free(node->needed);
+        free(node->needed_idx);
+        free(node->name);
+        free(node->path);
+        free(node->origin_path);
+        free(node->rpath);
+        free(node->runpath);
+        free(node->dynsyms);
+        free(node->dynstr);
+        free(node->providers);
+    }
+    free(graph->nodes);
+    free(graph->name_slots);
+    free(graph->file_slots);
+    for (uint64_t i = 0; i < graph->n_lib_dirs; i++) free(graph->lib_dirs[i]);
+    free(graph->lib_dirs);
+    free(graph->sysroot);
+    memset(graph, 0, sizeof(dep_graph));
+}
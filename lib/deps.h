@@ -0,0 +1,159 @@
+#include <elf.h>
+#include <stdint.h>
+
+#include "lib.h"
+
+/**
+ * Returned in a dep_node's 'providers' array for a symbol which is defined by
+ * the object itself, or which does not need resolving.
+ */
+#define DEP_SYM_DEFINED (-1)
+
+/**
+ * Returned in a dep_node's 'providers' array for an undefined symbol which no
+ * object in the graph defines.
+ */
+#define DEP_SYM_UNRESOLVED (-2)
+
+/**
+ * A shared object in the dependency graph of an ELF file.
+ */
+typedef struct dep_node {
+    // The name the object was requested by, as it appears in DT_NEEDED. For
+    // the root object this is its path.
+    char *name;
+
+    // The resolved path of the object with symlinks followed, or NULL if it
+    // could not be found.
+    char *path;
+
+    // The path the object was found at before following symlinks, whose
+    // directory $ORIGIN expands to.
+    char *origin_path;
+
+    // The index of the node which first requested this object. The root
+    // object is its own parent.
+    uint64_t parent;
+
+    // Set if the object was found but could not be parsed.
+    int error;
+
+    // Set if the object has no dynamic symbol table which could be read, so
+    // its symbols were not resolved.
+    int no_symbols;
+
+    // The device and inode of the resolved file, 0 if it was not found.
+    uint64_t dev;
+    uint64_t ino;
+
+    // The index of the node first resolved to the same file, which holds the
+    // parsed information, or -1 if this is that node.
+    int64_t alias;
+
+    // Set if a sysroot is used and the object was found outside of it, for
+    // example through $ORIGIN of a root object outside the sysroot.
+    int outside_sysroot;
+
+    // The DT_NEEDED names of the object.
+    char **needed;
+
+    // The graph node indexes of each entry in the 'needed' array.
+    uint64_t *needed_idx;
+
+    // The number of entries in the 'needed' and 'needed_idx' arrays.
+    uint64_t n_needed;
+
+    // The DT_RPATH and DT_RUNPATH strings of the object, or NULL if absent.
+    char *rpath;
+    char *runpath;
+
+    // The dynamic symbol table of the object and its string table.
+    Elf64_Sym *dynsyms;
+    uint64_t n_dynsyms;
+    char *dynstr;
+    uint64_t dynstr_size;
+
+    // For each entry in 'dynsyms', the index of the node providing the
+    // symbol, DEP_SYM_DEFINED or DEP_SYM_UNRESOLVED. Filled in by
+    // resolve_dep_symbols.
+    int64_t *providers;
+} dep_node;
+
+/**
+ * The dependency graph of an ELF file. Nodes are stored in breadth-first load
+ * order with the root object at index 0, which is also the order symbols are
+ * looked up in.
+ */
+typedef struct dep_graph {
+    // An array of the objects in the graph.
+    dep_node *nodes;
+
+    // The number of nodes in the 'nodes' array.
+    uint64_t n_nodes;
+
+    // The allocated capacity of the 'nodes' array.
+    uint64_t cap;
+
+    // Open addressed tables of node index + 1, keyed by the requested name
+    // and by resolved file, each with 'slots_cap' slots.
+    uint64_t *name_slots;
+    uint64_t *file_slots;
+    uint64_t slots_cap;
+
+    // The directory search paths are resolved relative to with its symlinks
+    // resolved, or "" for the host root. Symlinks inside the sysroot are
+    // resolved relative to it rather than the host root.
+    char *sysroot;
+
+    // The machine of the root object, dependencies for other machines are
+    // skipped during resolution.
+    uint16_t machine;
+
+    // The directories searched after DT_RPATH and DT_RUNPATH, as paths in
+    // the sysroot.
+    char **lib_dirs;
+
+    // The number of entries in the 'lib_dirs' array.
+    uint64_t n_lib_dirs;
+} dep_graph;
+
+/**
+ * Builds the shared library dependency graph of the ELF file described by the
+ * provided elf_ctx struct.
+ *
+ * DT_NEEDED entries are read from PT_DYNAMIC and resolved against DT_RPATH,
+ * DT_RUNPATH, the directories listed in /etc/ld.so.conf and its includes, the
+ * multiarch directories of the root object's machine and /lib64, /usr/lib64,
+ * /lib and /usr/lib, all relative to the given sysroot. ld.so.cache is not
+ * read, and $LIB and $PLATFORM are not expanded. Each object is parsed once,
+ * with each level of the graph being parsed in parallel.
+ *
+ * The graph must be freed with free_dep_graph, even on failure.
+ *
+ * @param ctx A pointer to the elf_ctx struct of the root object.
+ * @param sysroot The directory to resolve search paths relative to.
+ * @param n_threads The number of threads to parse objects with.
+ * @param graph A pointer to the dep_graph struct to store the graph in.
+ * @return 0 on success, -1 on failure.
+ */
+int build_dep_graph(elf_ctx *ctx, const char *sysroot, int n_threads,
+                    dep_graph *graph);
+
+/**
+ * Resolves the undefined dynamic symbols of every object in the graph against
+ * the symbols defined by the graph's objects, in load order. Symbol versions
+ * are not taken into account. Objects with 'no_symbols' set neither provide
+ * nor resolve symbols.
+ *
+ * @param graph A pointer to the dep_graph struct to resolve symbols in.
+ * @return The number of undefined, non-weak symbols which could not be
+ * resolved, or -1 on failure.
+ */
+int64_t resolve_dep_symbols(dep_graph *graph);
+
+/**
+ * Frees all memory held by the provided dep_graph struct.
+ *
+ * @param graph A pointer to the dep_graph struct to free.
+ */
+void free_dep_graph(dep_graph *graph);
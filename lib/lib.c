@@ -6,6 +6,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 int read_elf_header(FILE *fp, elf_ctx *ctx) {
     printf("Reading ELF header\n");
     if (fread(&ctx->elf_header, sizeof(Elf64_Ehdr), 1, fp) != 1) {
@@ -364,4 +368,294 @@ char *symbol_object_data(FILE *fp, elf_ctx *ctx, char *sym_name,
     }
 
     return data;
-};
\ No newline at end of file
+};
+
+char *read_segment(FILE *fp, Elf64_Phdr *phdr) {
+    if (phdr->p_filesz == 0) {
+        return NULL;
+    }
+    char *seg_data = calloc(phdr->p_filesz, 1);
+    if (fseek(fp, phdr->p_offset, SEEK_SET) < 0) {
+        perror("fseek");
+        free(seg_data);
+        return NULL;
+    }
+    if (fread(seg_data, phdr->p_filesz, 1, fp) != 1) {
+        perror("fread");
+        free(seg_data);
+        return NULL;
+    }
+    return seg_data;
+}
+
+// The number of bytes classified at once by char_mask.
+#define STRINGS_BLOCK 16
+
+static int is_printable(unsigned char c) {
+    return (c >= 0x20 && c <= 0x7e) || c == '\t';
+}
+
+// Returns a mask with bit i set if p[i] is a printable character.
+static uint32_t printable_mask(const unsigned char *p) {
+#if defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    // bytes >= 0x80 are negative as signed chars and fail the lower bound.
+    __m128i lo = _mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f));
+    __m128i hi = _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f));
+    __m128i tab = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_and_si128(lo, hi), tab));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < STRINGS_BLOCK; i++)
+        if (is_printable(p[i])) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+// Returns a mask with bit i set if p[i] is zero.
+static uint32_t zero_mask(const unsigned char *p) {
+#if defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < STRINGS_BLOCK; i++)
+        if (p[i] == 0) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+// Returns a mask with bit i set if a printable character in the given
+// encoding starts at p[i]. For 16-bit encodings this reads one byte past the
+// block.
+static uint32_t char_mask(const unsigned char *p, char encoding) {
+    switch (encoding) {
+        case 'l':
+            return printable_mask(p) & zero_mask(p + 1);
+        case 'b':
+            return zero_mask(p) & printable_mask(p + 1);
+        default:
+            return printable_mask(p);
+    }
+}
+
+// Scalar equivalent of char_mask for a single position.
+static int char_valid(const unsigned char *p, char encoding) {
+    switch (encoding) {
+        case 'l':
+            return is_printable(p[0]) && p[1] == 0;
+        case 'b':
+            return p[0] == 0 && is_printable(p[1]);
+        default:
+            return is_printable(p[0]);
+    }
+}
+
+static int push_string(elf_string **strs, uint64_t *n, uint64_t *cap,
+                       uint64_t offset, uint64_t len) {
+    if (*n == *cap) {
+        uint64_t new_cap = *cap ? *cap * 2 : 64;
+        elf_string *tmp = realloc(*strs, new_cap * sizeof(elf_string));
+        if (!tmp) {
+            perror("realloc");
+            return -1;
+        }
+        *strs = tmp;
+        *cap = new_cap;
+    }
+    (*strs)[*n].offset = offset;
+    (*strs)[*n].len = len;
+    (*n)++;
+    return 0;
+}
+
+static int cmp_string_offset(const void *a, const void *b) {
+    const elf_string *x = a, *y = b;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+uint64_t find_strings(const char *buf, uint64_t size, uint64_t min_len,
+                      char encoding, elf_string **strs) {
+    const unsigned char *p = (const unsigned char *)buf;
+    uint64_t width = (encoding == 'l' || encoding == 'b') ? 2 : 1;
+    // a run of 16-bit characters may start at an even or odd offset, so each
+    // alignment ("lane") tracks its own run.
+    uint64_t start[2] = {0};
+    int active[2] = {0};
+    uint64_t n = 0, cap = 0;
+    uint64_t i = 0;
+
+    *strs = NULL;
+    if (min_len == 0) min_len = 1;
+
+    // classify a block at a time and walk only the transitions between
+    // printable and non-printable characters within each lane.
+    for (; i + STRINGS_BLOCK + width - 1 <= size; i += STRINGS_BLOCK) {
+        uint32_t mask = char_mask(p + i, encoding);
+        for (uint64_t lane = 0; lane < width; lane++) {
+            uint32_t lane_bits = width == 1 ? 0xFFFF : (0x5555u << lane);
+            uint32_t valid = mask & lane_bits;
+            uint32_t invalid = ~mask & lane_bits;
+            uint32_t from = lane_bits;
+            for (;;) {
+                uint32_t next = (active[lane] ? invalid : valid) & from;
+                if (!next) break;
+                int bit = __builtin_ctz(next);
+                if (active[lane]) {
+                    uint64_t len = i + bit - start[lane];
+                    if (len / width >= min_len &&
+                        push_string(strs, &n, &cap, start[lane], len) != 0)
+                        goto fail;
+                } else {
+                    start[lane] = i + bit;
+                }
+                active[lane] = !active[lane];
+                from = lane_bits & ~((2u << bit) - 1);
+            }
+        }
+    }
+
+    for (; i + width <= size; i++) {
+        uint64_t lane = i % width;
+        int valid = char_valid(p + i, encoding);
+        if (valid && !active[lane]) {
+            start[lane] = i;
+            active[lane] = 1;
+        } else if (!valid && active[lane]) {
+            uint64_t len = i - start[lane];
+            if (len / width >= min_len &&
+                push_string(strs, &n, &cap, start[lane], len) != 0)
+                goto fail;
+            active[lane] = 0;
+        }
+    }
+
+    for (uint64_t lane = 0; lane < width; lane++) {
+        if (!active[lane]) continue;
+        uint64_t len = (size - start[lane]) / width * width;
+        if (len / width >= min_len &&
+            push_string(strs, &n, &cap, start[lane], len) != 0)
+            goto fail;
+    }
+
+    if (width > 1 && n > 1)
+        qsort(*strs, n, sizeof(elf_string), cmp_string_offset);
+    return n;
+
+fail:
+    free(*strs);
+    *strs = NULL;
+    return 0;
+}
+
+Elf64_Shdr *section_at_offset(elf_ctx *ctx, uint64_t offset, uint64_t *idx) {
+    for (uint64_t i = 1; i < ctx->n_sections; i++) {
+        Elf64_Shdr *sec = &ctx->section_headers[i];
+        if (sec->sh_type == SHT_NOBITS || sec->sh_size == 0) continue;
+        if (offset >= sec->sh_offset &&
+            offset < sec->sh_offset + sec->sh_size) {
+            *idx = i;
+            return sec;
+        }
+    }
+    return NULL;
+}
+
+static int cmp_symbol_addr(const void *a, const void *b) {
+    const Elf64_Sym *x = *(Elf64_Sym *const *)a, *y = *(Elf64_Sym *const *)b;
+    if (x->st_shndx != y->st_shndx)
+        return (x->st_shndx > y->st_shndx) - (x->st_shndx < y->st_shndx);
+    return (x->st_value > y->st_value) - (x->st_value < y->st_value);
+}
+
+int build_symbol_index(elf_ctx *ctx, symbol_index *idx) {
+    memset(idx, 0, sizeof(symbol_index));
+    if (ctx->n_symbols == 0) return 0;
+
+    idx->symbols = calloc(ctx->n_symbols, sizeof(Elf64_Sym *));
+    idx->max_end = calloc(ctx->n_symbols, sizeof(uint64_t));
+    if (!idx->symbols || !idx->max_end) {
+        perror("calloc");
+        free_symbol_index(idx);
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < ctx->n_symbols; i++) {
+        Elf64_Sym *sym = &ctx->symbols[i];
+        int type = ELF64_ST_TYPE(sym->st_info);
+        if (type != STT_OBJECT && type != STT_FUNC) continue;
+        if (sym->st_size == 0) continue;
+        idx->symbols[idx->n++] = sym;
+    }
+    qsort(idx->symbols, idx->n, sizeof(Elf64_Sym *), cmp_symbol_addr);
+
+    for (uint64_t i = 0; i < idx->n; i++) {
+        Elf64_Sym *sym = idx->symbols[i];
+        idx->max_end[i] = sym->st_value + sym->st_size;
+        if (i > 0 && idx->symbols[i - 1]->st_shndx == sym->st_shndx &&
+            idx->max_end[i - 1] > idx->max_end[i])
+            idx->max_end[i] = idx->max_end[i - 1];
+    }
+    return 0;
+}
+
+void free_symbol_index(symbol_index *idx) {
+    free(idx->symbols);
+    free(idx->max_end);
+    memset(idx, 0, sizeof(symbol_index));
+}
+
+Elf64_Sym *symbol_at_address(symbol_index *idx, uint64_t shndx, uint64_t addr) {
+    // find the last symbol starting at or before addr in the section.
+    uint64_t lo = 0, hi = idx->n;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        Elf64_Sym *sym = idx->symbols[mid];
+        if (sym->st_shndx < shndx ||
+            (sym->st_shndx == shndx && sym->st_value <= addr))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // walk back only while an earlier symbol in the section may still cover
+    // addr, which is rarely more than one step as symbols seldom overlap.
+    for (uint64_t i = lo; i-- > 0;) {
+        Elf64_Sym *sym = idx->symbols[i];
+        if (sym->st_shndx != shndx || idx->max_end[i] <= addr) break;
+        if (addr < sym->st_value + sym->st_size) return sym;
+    }
+    return NULL;
+}
+
+int vaddr_to_offset(elf_ctx *ctx, uint64_t vaddr, uint64_t *offset) {
+    for (uint64_t i = 0; i < ctx->n_prog_hdrs; i++) {
+        Elf64_Phdr *phdr = &ctx->program_headers[i];
+        if (phdr->p_type != PT_LOAD) continue;
+        if (vaddr >= phdr->p_vaddr && vaddr < phdr->p_vaddr + phdr->p_filesz) {
+            *offset = phdr->p_offset + (vaddr - phdr->p_vaddr);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+Elf64_Dyn *read_dynamic(FILE *fp, elf_ctx *ctx, uint64_t *n) {
+    Elf64_Phdr *dyn_seg = NULL;
+    for (uint64_t i = 0; i < ctx->n_prog_hdrs; i++) {
+        if (ctx->program_headers[i].p_type == PT_DYNAMIC) {
+            dyn_seg = &ctx->program_headers[i];
+            break;
+        }
+    }
+    if (!dyn_seg) return NULL;
+
+    Elf64_Dyn *dyn = (Elf64_Dyn *)read_segment(fp, dyn_seg);
+    if (!dyn) return NULL;
+
+    uint64_t max = dyn_seg->p_filesz / sizeof(Elf64_Dyn);
+    for (*n = 0; *n < max; (*n)++) {
+        if (dyn[*n].d_tag == DT_NULL) break;
+    }
+    return dyn;
+}
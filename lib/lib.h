@@ -7,6 +7,8 @@
 typedef struct elf_ctx {
     // Handle to the open ELF file.
     FILE *fp;
+    // Path of the open ELF file, if known.
+    const char *path;
     // The ELF header of the parsed file.
     Elf64_Ehdr elf_header;
 
@@ -189,4 +191,130 @@ void print_symbols(FILE *fp, elf_ctx *ctx);
  * @param idx A pointer to an integer to store the index of the symbol in the symbol table.
  * @return A pointer to the buffer containing the symbol object data on success, or NULL on failure.
  */
-char *symbol_object_data(FILE *fp, elf_ctx *ctx, char *sym_name, uint64_t *idx);
\ No newline at end of file
+char *symbol_object_data(FILE *fp, elf_ctx *ctx, char *sym_name, uint64_t *idx);
+
+/**
+ * Reads a segment's data into a buffer and returns it.
+ *
+ * @param fp A pointer to the file to read the segment from.
+ * @param phdr A pointer to the program header of the segment to read.
+ * @return A pointer to the buffer containing the segment data.
+ */
+char *read_segment(FILE *fp, Elf64_Phdr *phdr);
+
+/**
+ * A run of printable characters found by find_strings.
+ */
+typedef struct elf_string {
+    // Byte offset of the first character within the scanned buffer.
+    uint64_t offset;
+
+    // Length of the run in bytes, two bytes per character for 16-bit
+    // encodings.
+    uint64_t len;
+} elf_string;
+
+/**
+ * Finds runs of printable characters in the given buffer, the same way
+ * strings(1) does. A character is printable if it is in the range 0x20-0x7e
+ * or is a tab.
+ *
+ * The encoding selects the character width:
+ *   's' - single byte, 7-bit ASCII.
+ *   'l' - 16-bit little endian.
+ *   'b' - 16-bit big endian.
+ *
+ * The caller must always free the returned elf_string array.
+ *
+ * @param buf The buffer to scan.
+ * @param size The size of the buffer in bytes.
+ * @param min_len The minimum number of characters a run must have.
+ * @param encoding The character encoding to search for.
+ * @param strs A pointer to store the allocated array of elf_string structs in.
+ * @return The number of strings found, or 0 if none are found or on failure.
+ */
+uint64_t find_strings(const char *buf, uint64_t size, uint64_t min_len,
+                      char encoding, elf_string **strs);
+
+/**
+ * Returns the section whose file contents contain the given file offset.
+ * Sections which occupy no space in the file (SHT_NOBITS) are skipped.
+ *
+ * @param ctx A pointer to the elf_ctx struct containing the parsed information.
+ * @param offset The file offset to look up.
+ * @param idx A pointer to an integer to store the index of the section in.
+ * @return A pointer to the section header on success, or NULL if no section
+ * contains the offset.
+ */
+Elf64_Shdr *section_at_offset(elf_ctx *ctx, uint64_t offset, uint64_t *idx);
+
+/**
+ * An index of the object and function symbols of an ELF file, sorted by
+ * section and address for lookups with symbol_at_address.
+ */
+typedef struct symbol_index {
+    // The indexed symbols, sorted by st_shndx and then st_value.
+    Elf64_Sym **symbols;
+
+    // For each entry in 'symbols', the highest end address of it and every
+    // entry before it in the same section.
+    uint64_t *max_end;
+
+    // The number of entries in the 'symbols' and 'max_end' arrays.
+    uint64_t n;
+} symbol_index;
+
+/**
+ * Builds an index of the object and function symbols in the provided elf_ctx
+ * struct. The index must be freed with free_symbol_index.
+ *
+ * @param ctx A pointer to the elf_ctx struct containing the parsed information.
+ * @param idx A pointer to the symbol_index struct to store the index in.
+ * @return 0 on success, -1 on failure.
+ */
+int build_symbol_index(elf_ctx *ctx, symbol_index *idx);
+
+/**
+ * Frees all memory held by the provided symbol_index struct.
+ *
+ * @param idx A pointer to the symbol_index struct to free.
+ */
+void free_symbol_index(symbol_index *idx);
+
+/**
+ * Returns the indexed symbol defined in the given section whose value range
+ * contains the given address.
+ *
+ * @param idx A pointer to the symbol_index struct to search.
+ * @param shndx The index of the section the address is in.
+ * @param addr The address to look up.
+ * @return A pointer to the symbol on success, or NULL if no symbol contains
+ * the address.
+ */
+Elf64_Sym *symbol_at_address(symbol_index *idx, uint64_t shndx, uint64_t addr);
+
+/**
+ * Translates a virtual address into a file offset using the PT_LOAD segments
+ * in the provided elf_ctx struct.
+ *
+ * @param ctx A pointer to the elf_ctx struct containing the parsed information.
+ * @param vaddr The virtual address to translate.
+ * @param offset A pointer to store the translated file offset in.
+ * @return 0 on success, -1 if no loaded segment contains the address.
+ */
+int vaddr_to_offset(elf_ctx *ctx, uint64_t vaddr, uint64_t *offset);
+
+/**
+ * Reads the dynamic section pointed to by the PT_DYNAMIC program header.
+ * Also sets the integer pointed to by n to the number of entries read, not
+ * including the terminating DT_NULL entry.
+ *
+ * The caller must always free the returned Elf64_Dyn array.
+ *
+ * @param fp A pointer to the file to read the dynamic section from.
+ * @param ctx A pointer to the elf_ctx struct containing the parsed information.
+ * @param n A pointer to an integer to store the number of entries in.
+ * @return A pointer to the array of Elf64_Dyn structs on success, or NULL if
+ * the file has no PT_DYNAMIC segment or on failure.
+ */
+Elf64_Dyn *read_dynamic(FILE *fp, elf_ctx *ctx, uint64_t *n);
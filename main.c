@@ -21,6 +21,7 @@ int main(int argc, char *argv[]) {
     FILE *fp = fopen(SAMPLE_ELF_PATH, "r");
 
     parse_elf(fp, &ctx);
+    ctx.path = SAMPLE_ELF_PATH;
 
     shell_start(&ctx);
 
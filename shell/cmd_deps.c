@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../cmd_tree/include/cmd_tree.h"
+#include "../lib/deps.h"
+
+static void deps_usage(void) {
+    printf("usage: deps [-s sysroot] [-j threads] [-v]\n");
+    printf("  searches DT_RPATH, DT_RUNPATH, <sysroot>/etc/ld.so.conf and the\n"
+           "  default library directories, ld.so.cache is not read.\n");
+}
+
+static void print_dep_graph(dep_graph *graph) {
+    printf("Dependency graph:\n");
+    for (uint64_t i = 0; i < graph->n_nodes; i++) {
+        dep_node *node = &graph->nodes[i];
+        if (!node->path || node->alias >= 0) continue;
+        printf("  %s", node->name);
+        if (strcmp(node->name, node->path) != 0) printf(" (%s)", node->path);
+        if (node->outside_sysroot) printf(" [outside sysroot]");
+        if (node->error) printf(" [parse error]");
+        if (node->no_symbols) printf(" [no symbol table]");
+        printf("\n");
+        for (uint64_t j = 0; j < node->n_needed; j++) {
+            dep_node *dep = &graph->nodes[node->needed_idx[j]];
+            printf("    %s => %s\n", node->needed[j],
+                   dep->path ? dep->path : "not found");
+        }
+    }
+}
+
+// Prints the undefined symbols of each object which were not resolved, or
+// every resolved binding as well if 'verbose' is set.
+static void print_dep_symbols(dep_graph *graph, int verbose) {
+    printf("Undefined symbols:\n");
+    for (uint64_t i = 0; i < graph->n_nodes; i++) {
+        dep_node *node = &graph->nodes[i];
+        for (uint64_t j = 0; j < node->n_dynsyms; j++) {
+            int64_t provider = node->providers[j];
+            const char *name = node->dynstr + node->dynsyms[j].st_name;
+            if (provider == DEP_SYM_DEFINED) continue;
+            if (provider == DEP_SYM_UNRESOLVED) {
+                printf("  %s: %s => unresolved%s\n", node->name, name,
+                       ELF64_ST_BIND(node->dynsyms[j].st_info) == STB_WEAK
+                           ? " (weak)"
+                           : "");
+            } else if (verbose) {
+                printf("  %s: %s => %s\n", node->name, name,
+                       graph->nodes[provider].name);
+            }
+        }
+    }
+}
+
+int deps_cmd_exec(void *ctx, uint8_t argc, char **argv) {
+    elf_ctx *elf = (elf_ctx *)ctx;
+    const char *sysroot = "";
+    int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int verbose = 0;
+    dep_graph graph;
+
+    for (uint8_t i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sysroot = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else {
+            deps_usage();
+            return 1;
+        }
+    }
+    if (n_threads < 1) n_threads = 1;
+
+    if (!elf->fp) {
+        printf("No ELF file loaded\n");
+        return 1;
+    }
+
+    if (build_dep_graph(elf, sysroot, n_threads, &graph) != 0) {
+        printf("Error building dependency graph\n");
+        free_dep_graph(&graph);
+        return 1;
+    }
+
+    int64_t unresolved = resolve_dep_symbols(&graph);
+    uint64_t missing = 0, objects = 0, unchecked = 0;
+
+    print_dep_graph(&graph);
+    for (uint64_t i = 0; i < graph.n_nodes; i++) {
+        if (graph.nodes[i].path) {
+            if (graph.nodes[i].alias >= 0) continue;
+            objects++;
+            if (graph.nodes[i].error || graph.nodes[i].no_symbols) unchecked++;
+            continue;
+        }
+        if (missing++ == 0) printf("Not found:\n");
+        printf("  %s (needed by %s)\n", graph.nodes[i].name,
+               graph.nodes[graph.nodes[i].parent].name);
+    }
+    if (unresolved >= 0) print_dep_symbols(&graph, verbose);
+
+    printf("%lu objects, %lu not found, %ld unresolved symbols", objects,
+           missing, unresolved);
+    // symbols of objects which could not be read were not checked, so the
+    // unresolved count is incomplete.
+    if (unchecked) printf(", %lu objects not checked", unchecked);
+    printf("\n");
+
+    free_dep_graph(&graph);
+    return 1;
+}
+
+cmd_tree_node_t deps_node = {
+    .name = "deps",
+    .exec = deps_cmd_exec,
+};
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cmd_tree/include/cmd_tree.h"
+#include "../lib/lib.h"
+
+#define STRINGS_DEFAULT_MIN_LEN 4
+
+static void strings_usage(void) {
+    printf("usage: strings [-n min-len] [-e s|l|b] [section | -p segment]\n");
+}
+
+// State shared by every print_strings call of a single command invocation,
+// so tables are loaded once rather than per string.
+typedef struct strings_ctx {
+    elf_ctx *elf;
+    symbol_index syms;
+
+    // The section header string table and the symbol string table.
+    char *shstrtab;
+    uint64_t shstrtab_size;
+    char *strtab;
+    uint64_t strtab_size;
+
+    uint64_t min_len;
+    char encoding;
+} strings_ctx;
+
+// Reads a string table section, or returns NULL if it is not null
+// terminated.
+static char *read_strtab(FILE *fp, Elf64_Shdr *sec, uint64_t *size) {
+    char *tbl = read_section(fp, sec);
+    if (tbl && tbl[sec->sh_size - 1] != '\0') {
+        free(tbl);
+        tbl = NULL;
+    }
+    *size = tbl ? sec->sh_size : 0;
+    return tbl;
+}
+
+static const char *table_string(char *tbl, uint64_t size, uint64_t off) {
+    return off < size ? tbl + off : "";
+}
+
+static int strings_ctx_init(strings_ctx *sctx, elf_ctx *elf) {
+    memset(sctx, 0, sizeof(strings_ctx));
+    sctx->elf = elf;
+    if (build_symbol_index(elf, &sctx->syms) != 0) return -1;
+
+    if (elf->elf_header.e_shstrndx < elf->n_sections)
+        sctx->shstrtab = read_strtab(
+            elf->fp, &elf->section_headers[elf->elf_header.e_shstrndx],
+            &sctx->shstrtab_size);
+
+    Elf64_Shdr *symtab = &elf->section_headers[elf->symtab_sec_index];
+    if (elf->n_symbols && symtab->sh_link < elf->n_sections)
+        sctx->strtab = read_strtab(
+            elf->fp, &elf->section_headers[symtab->sh_link],
+            &sctx->strtab_size);
+    return 0;
+}
+
+static void strings_ctx_free(strings_ctx *sctx) {
+    free_symbol_index(&sctx->syms);
+    free(sctx->shstrtab);
+    free(sctx->strtab);
+}
+
+// Prints the printable strings found in buf, which holds the file contents
+// starting at file offset 'base'. Each string is annotated with the section
+// and symbol which contain it. If 'sec' is NULL the containing section is
+// looked up from the file offset of each string.
+static void print_strings(strings_ctx *sctx, const char *buf, uint64_t size,
+                          uint64_t base, Elf64_Shdr *sec, uint64_t shndx) {
+    elf_ctx *elf = sctx->elf;
+    uint64_t width = sctx->encoding == 's' ? 1 : 2;
+    int lookup = sec == NULL;
+    elf_string *strs;
+    uint64_t n =
+        find_strings(buf, size, sctx->min_len, sctx->encoding, &strs);
+
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t off = base + strs[i].offset;
+
+        // strings are in offset order, so the last section usually still
+        // contains the next one.
+        if (lookup && (!sec || off < sec->sh_offset ||
+                       off >= sec->sh_offset + sec->sh_size))
+            sec = section_at_offset(elf, off, &shndx);
+
+        if (sec) {
+            uint64_t sec_off = off - sec->sh_offset;
+            printf("  %s+0x%lx",
+                   table_string(sctx->shstrtab, sctx->shstrtab_size,
+                                sec->sh_name),
+                   sec_off);
+
+            Elf64_Sym *sym =
+                symbol_at_address(&sctx->syms, shndx, sec->sh_addr + sec_off);
+            if (sym) {
+                printf(" <%s+0x%lx>",
+                       table_string(sctx->strtab, sctx->strtab_size,
+                                    sym->st_name),
+                       sec->sh_addr + sec_off - sym->st_value);
+            }
+        } else {
+            printf("  0x%lx", off);
+        }
+
+        printf(": ");
+        // for 16-bit encodings only print the non-zero byte of each char.
+        uint64_t first = sctx->encoding == 'b' ? 1 : 0;
+        for (uint64_t j = first; j < strs[i].len; j += width)
+            putchar(buf[strs[i].offset + j]);
+        putchar('\n');
+    }
+    free(strs);
+}
+
+// Parses the whole of 'str' as a non-negative decimal integer. Returns 0 on
+// success or -1 if it is empty, negative or has trailing characters.
+static int parse_uint(const char *str, uint64_t *val) {
+    char *end;
+    if (str[0] < '0' || str[0] > '9') return -1;
+    *val = strtoul(str, &end, 10);
+    return *end == '\0' ? 0 : -1;
+}
+
+int strings_cmd_exec(void *ctx, uint8_t argc, char **argv) {
+    elf_ctx *elf = (elf_ctx *)ctx;
+    uint64_t min_len = STRINGS_DEFAULT_MIN_LEN;
+    char encoding = 's';
+    char *target = NULL;
+    uint64_t segment = 0;
+    int use_segment = 0;
+
+    for (uint8_t i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            if (parse_uint(argv[++i], &min_len) != 0 || min_len == 0) {
+                strings_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            encoding = argv[++i][0];
+            if ((encoding != 's' && encoding != 'l' && encoding != 'b') ||
+                argv[i][1] != '\0') {
+                strings_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            if (parse_uint(argv[++i], &segment) != 0) {
+                strings_usage();
+                return 1;
+            }
+            use_segment = 1;
+        } else if (argv[i][0] != '-' && !target) {
+            target = argv[i];
+        } else {
+            strings_usage();
+            return 1;
+        }
+    }
+
+    // a segment and a section can not both be scanned.
+    if (use_segment && target) {
+        strings_usage();
+        return 1;
+    }
+
+    if (!elf->fp) {
+        printf("No ELF file loaded\n");
+        return 1;
+    }
+
+    if (use_segment && segment >= elf->n_prog_hdrs) {
+        printf("No segment at index %lu\n", segment);
+        return 1;
+    }
+
+    strings_ctx sctx;
+    if (strings_ctx_init(&sctx, elf) != 0) return 1;
+    sctx.min_len = min_len;
+    sctx.encoding = encoding;
+
+    if (use_segment) {
+        Elf64_Phdr *phdr = &elf->program_headers[segment];
+        char *data = read_segment(elf->fp, phdr);
+        if (data) {
+            print_strings(&sctx, data, phdr->p_filesz, phdr->p_offset, NULL,
+                          0);
+            free(data);
+        }
+        strings_ctx_free(&sctx);
+        return 1;
+    }
+
+    int found = 0;
+    for (uint64_t i = 1; i < elf->n_sections; i++) {
+        Elf64_Shdr *sec = &elf->section_headers[i];
+        if (sec->sh_type == SHT_NOBITS) continue;
+        if (target && strcmp(table_string(sctx.shstrtab, sctx.shstrtab_size,
+                                          sec->sh_name),
+                             target) != 0)
+            continue;
+        found = 1;
+        char *data = read_section(elf->fp, sec);
+        if (!data) continue;
+        print_strings(&sctx, data, sec->sh_size, sec->sh_offset, sec, i);
+        free(data);
+    }
+
+    if (target && !found) printf("No section named %s\n", target);
+    strings_ctx_free(&sctx);
+    return 1;
+}
+
+cmd_tree_node_t strings_node = {
+    .name = "strings",
+    .exec = strings_cmd_exec,
+};
@@ -8,6 +8,8 @@
 
 // command nodes are implemented in their own .c files.
 extern cmd_tree_node_t program_headers_node;
+extern cmd_tree_node_t strings_node;
+extern cmd_tree_node_t deps_node;
 
 int root_cmd_exec(void *ctx, uint8_t argc, char **argv) {
     printf("No handler for this command.\n");
@@ -32,6 +34,12 @@ int shell_start(elf_ctx *ctx) {
     // 'programs' command to list program headers.
     cmd_tree_node_add_child(&root, &program_headers_node);
 
+    // 'strings' command to list printable strings in sections or segments.
+    cmd_tree_node_add_child(&root, &strings_node);
+
+    // 'deps' command to resolve the shared library dependency graph.
+    cmd_tree_node_add_child(&root, &deps_node);
+
     for (;;) {
         int r;
         write(STDIN_FILENO, "ELF> ", sizeof("ELF> "));